@@ -0,0 +1,106 @@
+# Checks the in-situ output of heat_seq on a 10x10 grid and, when HEAT_PAR is
+# given, that heat_par on 2x2 processes writes the same files: the frames
+# may differ by 1 per colour channel, their pixels being summed up in a
+# different order, and the statistics must be identical. With
+# CHECK_MEAN, the mean of every step must stay 0.5, as it does with Neumann
+# or periodic boundaries.
+#
+# usage: cmake -DHEAT_SEQ=<heat_seq> -DWORK_DIR=<dir> [-DBC=<bc>] [-DCHECK_MEAN=ON]
+#              [-DHEAT_PAR=<heat_par> -DMPIEXEC=<mpiexec> -DNP_FLAG=<flag>]
+#              -P check_insitu.cmake
+
+if(NOT BC)
+  set(BC 0)
+endif()
+set(FRAMES frame_00000.ppm frame_00001.ppm)
+set(FILES heat_stats.txt ${FRAMES})
+
+# Fails unless the PPM images a and b have the same header and their colour
+# channels differ by 1 at most
+function(compare_ppm a b)
+  file(READ ${a} hex_a HEX)
+  file(READ ${b} hex_b HEX)
+  string(LENGTH "${hex_a}" len_a)
+  string(LENGTH "${hex_b}" len_b)
+  if(NOT len_a EQUAL len_b)
+    message(FATAL_ERROR "${a} and ${b} differ in size")
+  endif()
+  set(digits "0123456789abcdef")
+  # the header is made of 3 lines
+  set(newlines 0)
+  math(EXPR last "${len_a} - 2")
+  foreach(pos RANGE 0 ${last} 2)
+    string(SUBSTRING "${hex_a}" ${pos} 2 byte_a)
+    string(SUBSTRING "${hex_b}" ${pos} 2 byte_b)
+    if(newlines LESS 3)
+      if(NOT byte_a STREQUAL byte_b)
+        message(FATAL_ERROR "${a} and ${b} headers differ")
+      endif()
+      if(byte_a STREQUAL "0a")
+        math(EXPR newlines "${newlines} + 1")
+      endif()
+    elseif(NOT byte_a STREQUAL byte_b)
+      foreach(x a b)
+        string(SUBSTRING "${byte_${x}}" 0 1 hi)
+        string(SUBSTRING "${byte_${x}}" 1 1 lo)
+        string(FIND "${digits}" "${hi}" hi)
+        string(FIND "${digits}" "${lo}" lo)
+        math(EXPR val_${x} "16 * ${hi} + ${lo}")
+      endforeach()
+      math(EXPR diff "${val_a} - ${val_b}")
+      if(diff GREATER 1 OR diff LESS -1)
+        math(EXPR offset "${pos} / 2")
+        message(FATAL_ERROR "${a} and ${b} differ at byte ${offset}: ${val_a} != ${val_b}")
+      endif()
+    endif()
+  endforeach()
+endfunction()
+
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR}/seq)
+
+execute_process(COMMAND ${HEAT_SEQ} 10 10 20 0 0 10 2 ${BC}
+                WORKING_DIRECTORY ${WORK_DIR}/seq
+                RESULT_VARIABLE res OUTPUT_QUIET)
+if(res)
+  message(FATAL_ERROR "heat_seq failed: ${res}")
+endif()
+foreach(f ${FILES})
+  if(NOT EXISTS ${WORK_DIR}/seq/${f})
+    message(FATAL_ERROR "heat_seq did not write ${f}")
+  endif()
+endforeach()
+file(STRINGS ${WORK_DIR}/seq/heat_stats.txt steps REGEX "^[0-9]")
+list(LENGTH steps nb_steps)
+if(NOT nb_steps EQUAL 20)
+  message(FATAL_ERROR "heat_stats.txt has ${nb_steps} steps instead of 20")
+endif()
+if(CHECK_MEAN)
+  foreach(step ${steps})
+    # it  t  min  max  mean  err
+    string(REGEX REPLACE " +" ";" fields "${step}")
+    list(GET fields 4 mean)
+    if(NOT mean STREQUAL "5.000000e-01")
+      message(FATAL_ERROR "the mean is not conserved: ${step}")
+    endif()
+  endforeach()
+endif()
+
+if(HEAT_PAR)
+  file(MAKE_DIRECTORY ${WORK_DIR}/par)
+  execute_process(COMMAND ${MPIEXEC} ${NP_FLAG} 4 ${HEAT_PAR} 10 10 20 2 2 0 10 2 ${BC}
+                  WORKING_DIRECTORY ${WORK_DIR}/par
+                  RESULT_VARIABLE res OUTPUT_QUIET)
+  if(res)
+    message(FATAL_ERROR "heat_par failed: ${res}")
+  endif()
+  execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files
+                          ${WORK_DIR}/seq/heat_stats.txt ${WORK_DIR}/par/heat_stats.txt
+                  RESULT_VARIABLE res)
+  if(res)
+    message(FATAL_ERROR "heat_par and heat_seq heat_stats.txt differ")
+  endif()
+  foreach(f ${FRAMES})
+    compare_ppm(${WORK_DIR}/seq/${f} ${WORK_DIR}/par/${f})
+  endforeach()
+endif()
@@ -8,6 +8,7 @@
  *
  */
 #include "heat.h"
+#include "insitu.h"
 #include "mat_utils.h"
 #include <math.h>
 #include <mpi.h>
@@ -52,6 +53,34 @@ set_bounds (const int *coo, int nc_x, int nc_y, int size_x, int size_y,
 
 }
 
+/**
+ * @brief Procedure which puts ones on the first half of the global solution.
+ *
+ * @details This is the initial state used with Neumann or periodic
+ * boundaries, which do not bring any heat: the significant cells whose
+ * global row is in the first half of the @e gx rows are set to 1.0.
+ *
+ * @param coo integer pair containing the coordinates in 2D cartesian topology
+ * @param gx rows number of the global solution
+ * @param size_x rows number of the local part of the solution
+ * @param size_y columns number of the local part of the solution
+ * @param u local part of the solution
+ */
+static void
+set_half (const int *coo, int gx, int size_x, int size_y, double *u)
+{
+
+  int i, j;
+  for (i = 1; i < size_x - 1; ++i)
+    {
+      if (coo[0] * (size_x - 2) + i > gx / 2)
+        break;
+      for (j = 1; j < size_y - 1; ++j)
+        u[i * size_y + j] = 1.;
+    }
+
+}
+
 /**
  * @brief Procedure for swapping the boundaries (2 columns and 2 rows)
  * with the neighbour processes
@@ -105,6 +134,243 @@ ghosts_swap (MPI_Comm comm, MPI_Datatype col,
 
 }
 
+/**
+ * @brief State of the in-situ output of a process
+ *
+ * @details The image is split into tiles: the tile of a process holds the
+ * pixels its cells fall into. Pixels whose block of cells crosses the
+ * boundary between processes belong to several tiles, the contributions
+ * being summed up by rank 0 when it assembles the image.
+ */
+struct insitu_state
+{
+  int period;       /**< period of the frames, 0 when disabled */
+  int down;         /**< downsampling factor */
+  int gx;           /**< significant cells in X of the global solution */
+  int gy;           /**< significant cells in Y of the global solution */
+  int tile[4];      /**< first pixel in X and Y and size in X and Y of the tile */
+  int off[2];       /**< first local cell in X and Y, relatively to the first
+                         cell of the first pixel of the tile */
+  double *buf;      /**< local tile */
+  MPI_Op op;        /**< reduction of the struct field_stats */
+  int *tiles;       /**< tile of each process, rank 0 only */
+  int *counts;      /**< size of the tile of each process, rank 0 only */
+  int *displs;      /**< offset of the tile of each process, rank 0 only */
+  double *recv;     /**< gathered tiles, rank 0 only */
+  double *img;      /**< the image, rank 0 only */
+  FILE *stats;      /**< the time series file, rank 0 only */
+};
+
+/**
+ * @brief Reduction operator merging struct field_stats given as groups of 4
+ * MPI_DOUBLE
+ *
+ * @param in the statistics to merge
+ * @param inout the statistics to merge into
+ * @param len the number of MPI_DOUBLE
+ * @param type the datatype, MPI_DOUBLE
+ */
+static void
+stats_merge (void *in, void *inout, int *len, MPI_Datatype *type)
+{
+  int i;
+  const struct field_stats *a = (const struct field_stats *) in;
+  struct field_stats *b = (struct field_stats *) inout;
+
+  (void) type;
+  for (i = 0; i < *len / 4; ++i)
+    {
+      b[i].min = MIN (a[i].min, b[i].min);
+      if (a[i].max > b[i].max)
+        b[i].max = a[i].max;
+      b[i].sum += a[i].sum;
+      b[i].count += a[i].count;
+    }
+}
+
+/**
+ * @brief Computes the pixels of the image covered by the local part of the
+ * solution of a process
+ *
+ * @param coo integer pair containing the coordinates in 2D cartesian topology
+ * @param cell_x rows number of significant cells of each process
+ * @param cell_y columns number of significant cells of each process
+ * @param down the downsampling factor
+ * @param tile the first pixel in X and Y and the size in X and Y of the tile
+ */
+static void
+tile_bounds (const int *coo, int cell_x, int cell_y, int down, int *tile)
+{
+  tile[0] = coo[0] * cell_x / down;
+  tile[1] = coo[1] * cell_y / down;
+  tile[2] = (coo[0] * cell_x + cell_x - 1) / down - tile[0] + 1;
+  tile[3] = (coo[1] * cell_y + cell_y - 1) / down - tile[1] + 1;
+}
+
+/**
+ * @brief Procedure which prepares the in-situ output
+ *
+ * @details Nothing is allocated when @e period is 0. Rank 0 opens the
+ * statistics file and allocates the image and the tiles of every process.
+ *
+ * @param comm the 2D communicator
+ * @param period the period of the frames, 0 to disable in-situ output
+ * @param down the downsampling factor
+ * @param cell_x rows number of significant cells of each process
+ * @param cell_y columns number of significant cells of each process
+ * @param ist the state to initialize
+ */
+static void
+insitu_init (MPI_Comm comm, int period, int down, int cell_x, int cell_y,
+             struct insitu_state *ist)
+{
+  int r, rank, size, total;
+  int dims[2], periods[2], coo[2];
+
+  memset (ist, 0, sizeof (*ist));
+  ist->period = period;
+  ist->down = down;
+  if (period == 0)
+    return;
+
+  MPI_Comm_rank (comm, &rank);
+  MPI_Comm_size (comm, &size);
+  MPI_Cart_get (comm, 2, dims, periods, coo);
+  ist->gx = dims[0] * cell_x;
+  ist->gy = dims[1] * cell_y;
+  tile_bounds (coo, cell_x, cell_y, down, ist->tile);
+  ist->off[0] = coo[0] * cell_x - ist->tile[0] * down;
+  ist->off[1] = coo[1] * cell_y - ist->tile[1] * down;
+  MPI_Op_create (stats_merge, 1, &ist->op);
+
+  ist->buf = (double *) calloc (ist->tile[2] * ist->tile[3], sizeof (double));
+  if (ist->buf == NULL)
+    {
+      printf("not enough memory!\n");
+      exit(-1);
+    }
+  if (rank != 0)
+    return;
+
+  ist->tiles = (int *) calloc (4 * size, sizeof (int));
+  ist->counts = (int *) calloc (size, sizeof (int));
+  ist->displs = (int *) calloc (size, sizeof (int));
+  if (ist->tiles == NULL || ist->counts == NULL || ist->displs == NULL)
+    {
+      printf("not enough memory!\n");
+      exit(-1);
+    }
+  total = 0;
+  for (r = 0; r < size; ++r)
+    {
+      MPI_Cart_coords (comm, r, 2, coo);
+      tile_bounds (coo, cell_x, cell_y, down, &ist->tiles[4 * r]);
+      ist->counts[r] = ist->tiles[4 * r + 2] * ist->tiles[4 * r + 3];
+      ist->displs[r] = total;
+      total += ist->counts[r];
+    }
+  ist->recv = (double *) calloc (total, sizeof (double));
+  ist->img = (double *) calloc (((ist->gx + down - 1) / down)
+                                * ((ist->gy + down - 1) / down),
+                                sizeof (double));
+  if (ist->recv == NULL || ist->img == NULL)
+    {
+      printf("not enough memory!\n");
+      exit(-1);
+    }
+  ist->stats = fopen ("heat_stats.txt", "w");
+  if (ist->stats == NULL)
+    fprintf (stderr, "Error: unable to open <heat_stats.txt>\n");
+}
+
+/**
+ * @brief Procedure which releases the in-situ output
+ *
+ * @param ist the state to release
+ */
+static void
+insitu_free (struct insitu_state *ist)
+{
+  if (ist->period == 0)
+    return;
+  if (ist->stats != NULL)
+    fclose (ist->stats);
+  free (ist->img);
+  free (ist->recv);
+  free (ist->displs);
+  free (ist->counts);
+  free (ist->tiles);
+  free (ist->buf);
+  MPI_Op_free (&ist->op);
+}
+
+/**
+ * @brief Procedure for the in-situ output of one step
+ *
+ * @details The statistics are merged with a single reduction on the process
+ * of rank 0, which appends them to the statistics file. Every @e period
+ * iterations, each process accumulates its cells into its tile of the
+ * downsampled image; the tiles are gathered on rank 0, which assembles and
+ * saves the frame. Only the downsampled tiles are ever communicated, never
+ * the full solution.
+ *
+ * @param comm the 2D communicator
+ * @param it the iteration number
+ * @param t the simulated time
+ * @param err the global L2 change of the step
+ * @param size_x rows number of the local part of the solution
+ * @param size_y columns number of the local part of the solution
+ * @param u local part of the solution
+ * @param ist the in-situ output state
+ */
+static void
+insitu_output (MPI_Comm comm, int it, double t, double err,
+               int size_x, int size_y, const double *u,
+               struct insitu_state *ist)
+{
+  int rank, size, r, a, b;
+  int down = ist->down;
+  int img_y = (ist->gy + down - 1) / down;
+  const int *tile = ist->tile;
+  char name_fic[120];
+  struct field_stats st, st_glob;
+
+  MPI_Comm_rank (comm, &rank);
+
+  field_stats (size_x, size_y, u, &st);
+  MPI_Reduce (&st, &st_glob, 4, MPI_DOUBLE, ist->op, 0, comm);
+  if (rank == 0)
+    write_stats (ist->stats, it, t, &st_glob, err);
+
+  if (it % ist->period != 0)
+    return;
+
+  memset (ist->buf, 0, sizeof (double) * tile[2] * tile[3]);
+  downsample_acc (size_x, size_y, u, ist->off[0], ist->off[1], down,
+                  tile[3], ist->buf);
+  MPI_Gatherv (ist->buf, tile[2] * tile[3], MPI_DOUBLE, ist->recv,
+               ist->counts, ist->displs, MPI_DOUBLE, 0, comm);
+  if (rank != 0)
+    return;
+
+  MPI_Comm_size (comm, &size);
+  memset (ist->img, 0, sizeof (double) * ((ist->gx + down - 1) / down) * img_y);
+  for (r = 0; r < size; ++r)
+    {
+      const int *tr = &ist->tiles[4 * r];
+      const double *buf = &ist->recv[ist->displs[r]];
+      for (a = 0; a < tr[2]; ++a)
+        {
+          for (b = 0; b < tr[3]; ++b)
+            {
+              ist->img[(tr[0] + a) * img_y + tr[1] + b] += buf[a * tr[3] + b];
+            }
+        }
+    }
+  downsample_normalize (ist->gx, ist->gy, down, ist->img);
+  sprintf (name_fic, "frame_%05d.ppm", it / ist->period);
+  save_ppm (name_fic, (ist->gx + down - 1) / down, img_y, ist->img, 0., 1.);
+}
 
 /**
  * @brief A usage function
@@ -117,13 +383,16 @@ ghosts_swap (MPI_Comm comm, MPI_Datatype col,
 static void
 usage(char *argv[])
 {
-  fprintf(stderr, "Usage: mpirun -np (px*py) %s nx ny iter_max px py save\n", argv[0]);
+  fprintf(stderr, "Usage: mpirun -np (px*py) %s nx ny iter_max px py save [insitu [down [bc]]]\n", argv[0]);
   fprintf(stderr, "\tnx       number of discretisation points in X\n");
   fprintf(stderr, "\tny       number of discretisation points in Y\n");
   fprintf(stderr, "\titer_max maximal number of iterations in temporal loop\n");
   fprintf(stderr, "\tpx       X process number\n");
   fprintf(stderr, "\tpy       Y process number\n");
   fprintf(stderr, "\tsave     boolean flag (1 or 0) for recording states\n");
+  fprintf(stderr, "\tinsitu   period of the downsampled frames, 0 (default) disables in-situ output\n");
+  fprintf(stderr, "\tdown     downsampling factor of the frames (default 1)\n");
+  fprintf(stderr, "\tbc       boundary conditions: 0 (default) Dirichlet, 1 Neumann, 2 periodic\n");
   exit(EXIT_FAILURE);
 }
 
@@ -145,6 +414,15 @@ main (int argc, char *argv[])
   double hx, hy, dt, err_loc, err, iter_max, prec;
 
   double *u_in, *u_out, *vec_temp, *solution;
+  int insitu = 0, down = 1;
+  struct insitu_state ist;
+  int bc = HEAT_BC_DIRICHLET, sides;
+  struct heat_stencil stencil;
+
+  // time spent in each phase of the temporal loop
+  enum { T_COMPUTE, T_REDUCE, T_EXCHANGE, T_INSITU, T_TOTAL, T_NB };
+  double t_loc[T_NB] = { 0. }, t_max[T_NB], t0, t1;
+  int iters = 0;
 
   int rank_w, size_w;
 
@@ -176,6 +454,16 @@ main (int argc, char *argv[])
   nc_x = atoi (argv[4]);
   nc_y = atoi (argv[5]);
   save = atoi (argv[6]);
+  if (argc > 7)
+    insitu = atoi (argv[7]);
+  if (argc > 8)
+    down = atoi (argv[8]);
+  if (argc > 9)
+    bc = atoi (argv[9]);
+  if (insitu < 0 || down < 1 || bc < HEAT_BC_DIRICHLET || bc > HEAT_BC_PERIODIC)
+    {
+      usage(argv);
+    }
 
   if (nc_x * nc_y != size_w)
     {
@@ -186,8 +474,9 @@ main (int argc, char *argv[])
     }
   dims[0] = nc_x;
   dims[1] = nc_y;
-  periods[0] = 0;
-  periods[1] = 0;
+  // periodic boundaries are exchanged between the processes on both ends
+  periods[0] = (bc == HEAT_BC_PERIODIC);
+  periods[1] = (bc == HEAT_BC_PERIODIC);
   reorder = 1;
 
   // creation of a 2D cartesian topology (nc_x x nc_y processus)
@@ -203,6 +492,17 @@ main (int argc, char *argv[])
   MPI_Cart_shift (comm2D, 0, 1, &neighbours[N], &neighbours[S]);
   MPI_Cart_shift (comm2D, 1, 1, &neighbours[W], &neighbours[E]);
 
+  // the sides of the local part which are on the global boundary
+  sides = 0;
+  if (neighbours[N] == MPI_PROC_NULL)
+    sides |= HEAT_SIDE_N;
+  if (neighbours[S] == MPI_PROC_NULL)
+    sides |= HEAT_SIDE_S;
+  if (neighbours[E] == MPI_PROC_NULL)
+    sides |= HEAT_SIDE_E;
+  if (neighbours[W] == MPI_PROC_NULL)
+    sides |= HEAT_SIDE_W;
+
 
   cell_x = nx / nc_x;
   cell_y = ny / nc_y;
@@ -230,8 +530,15 @@ main (int argc, char *argv[])
       exit(-1);
      }
 
-  set_bounds (coords, nc_x, nc_y, size_x, size_y, u_in);
-  set_bounds (coords, nc_x, nc_y, size_x, size_y, u_out);
+  if (bc == HEAT_BC_DIRICHLET)
+    {
+      set_bounds (coords, nc_x, nc_y, size_x, size_y, u_in);
+      set_bounds (coords, nc_x, nc_y, size_x, size_y, u_out);
+    }
+  else
+    set_half (coords, nc_x * cell_x, size_x, size_y, u_in);
+
+  insitu_init (comm2D, insitu, down, cell_x, cell_y, &ist);
 
 
   hx = 1. / nx;
@@ -239,24 +546,63 @@ main (int argc, char *argv[])
   dt = MIN (SQR (hx) / 4., SQR (hy) / 4.);
   prec = 1e-4;
   err = 1e10;
+
+  stencil.hx = hx;
+  stencil.hy = hy;
+  stencil.dt = dt;
+  stencil.k = NULL;
+  stencil.src = NULL;
+  stencil.bc_x = (enum heat_bc) bc;
+  stencil.bc_y = (enum heat_bc) bc;
+
+  ghosts_swap (comm2D, type_col, neighbours, size_x, size_y, u_in);
+  heat_fill_bounds (&stencil, sides, size_x, size_y, u_in);
+
+  MPI_Barrier (comm2D);
+  t_loc[T_TOTAL] = MPI_Wtime ();
   // temporal loop
   for (i = 0; i < iter_max; ++i)
     {
 
-      err_loc = heat (hx, hy, dt, size_x, size_y, u_in, u_out);
+      t0 = MPI_Wtime ();
+      err_loc = heat_step (&stencil, size_x, size_y, u_in, u_out);
 
       // retrieve local error to compute the global error
+      t1 = MPI_Wtime ();
+      t_loc[T_COMPUTE] += t1 - t0;
       MPI_Allreduce (&err_loc, &err, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
       err = sqrt (err);
+      t_loc[T_REDUCE] += MPI_Wtime () - t1;
       if (rank_w == 0 && (i % 10 == 0))
         printf ("heat: it = %d, t = %.3e, err = %.3e\n", i, i * dt, err);
+      t0 = MPI_Wtime ();
+      if (insitu)
+        insitu_output (comm2D, i, (i + 1) * dt, err, size_x, size_y, u_out,
+                       &ist);
+      t1 = MPI_Wtime ();
+      t_loc[T_INSITU] += t1 - t0;
       memcpy (u_in, u_out, sizeof (double) * size_x * size_y);
 
       ghosts_swap (comm2D, type_col, neighbours, size_x, size_y, u_in);
+      heat_fill_bounds (&stencil, sides, size_x, size_y, u_in);
+      t_loc[T_EXCHANGE] += MPI_Wtime () - t1;
+      iters = i + 1;
 
       if (err <= prec)
         break;
     }
+  t_loc[T_TOTAL] = MPI_Wtime () - t_loc[T_TOTAL];
+
+  // the slowest process gives the time of each phase
+  MPI_Reduce (t_loc, t_max, T_NB, MPI_DOUBLE, MPI_MAX, 0, comm2D);
+  if (rank_2D == 0)
+    {
+      printf ("heat: timing ranks = %d, iters = %d, total = %.6e, compute = %.6e,"
+              " reduce = %.6e, exchange = %.6e, insitu = %.6e\n",
+              size_w, iters, t_max[T_TOTAL], t_max[T_COMPUTE], t_max[T_REDUCE],
+              t_max[T_EXCHANGE], t_max[T_INSITU]);
+      printf("<DartMeasurement name=\"Perf\" type=\"numeric/double\">%g</DartMeasurement>\n", t_max[T_TOTAL]);
+    }
 
   vec_temp = (double *) calloc (nc_x * nc_y * size_x * size_y, sizeof (double));
   // gather the big solution on the process of rank 0
@@ -290,6 +636,7 @@ main (int argc, char *argv[])
     }
 
   free (vec_temp);
+  insitu_free (&ist);
   MPI_Type_free (&type_col);
   free (u_out);
   free (u_in);
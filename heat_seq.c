@@ -8,6 +8,7 @@
  *
  */
 #include "heat.h"
+#include "insitu.h"
 #include "mat_utils.h"
 #include <math.h>
 #include <stdio.h>
@@ -81,22 +82,52 @@ set_bounds(int size_x, int size_y, double *u)
     }
 }
 
+/**
+ * @brief Set the first half of a 2-D map to 1.0
+ *
+ * @details This function is the initial state used with Neumann or periodic
+ * boundaries, which do not bring any heat. It sets to 1.0 the significant
+ * cells of the first half of the rows of @e u, so that the mean of the map
+ * stays 0.5 as the heat spreads.
+ *
+ * @param size_x The size in X of the @e u map
+ * @param size_y The size in Y of the @e u map
+ * @param u The map to initialize
+ */
+static void
+set_half(int size_x, int size_y, double *u)
+{
+  int i, j;
+
+  for (i = 1; i <= (size_x - 2) / 2; ++i)
+    {
+      for (j = 1; j < size_y - 1; ++j)
+        {
+          u[i * size_y + j] = 1.;
+        }
+    }
+}
+
 /**
  * @brief Compute the heat propagation equation using iterative approach
  * until convergence.
  *
  * @details This function will compute the heat propagation equation on the map
  * @e u_in using the iterative approach outputing the result in @e u_out.
- * @e dt, @e hx and @e hy give the derivation approximation steps over time,
- * X and Y. @e iter_max limits the maximum number of iteration if the computation
- * does not converge.
+ * The stencil @e s gives the derivation approximation steps over time, X and
+ * Y and the boundary conditions. @e iter_max limits the maximum number of
+ * iteration if the computation does not converge.
  *
- * @param hx the derivation approximation step in X
- * @param hy the derivation approximation step in Y
- * @param dt the derivation approximation step in time
+ * @param s the stencil description
  * @param iter_max the maximum number of iteration to perform.
  * @param save a boolean indicating if the results is to be saved in a file after
  *        each step
+ * @param print a boolean indicating if the results is to be printed after
+ *        each step
+ * @param insitu the period, in iterations, of the downsampled frames; the
+ *        statistics of each step are recorded in @e heat_stats.txt when it
+ *        is not 0
+ * @param down the downsampling factor of the frames
  * @param size_x The size in X of the @e u_in and @e u_out maps
  * @param size_y The size in Y of the @e u_in and @e u_out maps
  * @param u_in the input map, it will be modified and invalidated by the
@@ -104,25 +135,40 @@ set_bounds(int size_x, int size_y, double *u)
  * @param u_out the output map, it will contains the result of the computation
  */
 static void
-compute_heat_propagation(double hx, double hy, double dt,
+compute_heat_propagation(const struct heat_stencil *s,
                          int iter_max, int save, int print,
+                         int insitu, int down,
                          int size_x, int size_y,
                          double *u_in, double *u_out)
 {
-  int i;
+  int i, img_x, img_y;
   char name_fic[120];
   double err, prec;
+  double *img = NULL;
+  FILE *stats = NULL;
+  struct field_stats st;
 
   prec = 1e-7;
   err = 1e10;
 
+  img_x = (size_x - 2 + down - 1) / down;
+  img_y = (size_y - 2 + down - 1) / down;
+  if (insitu)
+    {
+      xalloc (img, img_x * img_y, double);
+      stats = fopen ("heat_stats.txt", "w");
+      if (stats == NULL)
+        fprintf (stderr, "Error: unable to open <heat_stats.txt>\n");
+    }
+
   for (i = 0; i < iter_max; ++i)
     {
-      err = heat (hx, hy, dt, size_x, size_y, u_in, u_out);
+      heat_fill_bounds (s, HEAT_SIDE_ALL, size_x, size_y, u_in);
+      err = heat_step (s, size_x, size_y, u_in, u_out);
       err = sqrt (err);
       if (i % 10 == 0)
         {
-         printf ("heat: it = %d, t = %.3e, err = %.3e\n", i, i * dt, err);
+         printf ("heat: it = %d, t = %.3e, err = %.3e\n", i, i * s->dt, err);
         }
       if (save)
         {
@@ -133,10 +179,27 @@ compute_heat_propagation(double hx, double hy, double dt,
         {
          print_mat (size_x, size_y, u_in);
         }
+      if (insitu)
+        {
+         field_stats (size_x, size_y, u_out, &st);
+         write_stats (stats, i, (i + 1) * s->dt, &st, err);
+         if (i % insitu == 0)
+           {
+            memset (img, 0, sizeof (double) * img_x * img_y);
+            downsample_acc (size_x, size_y, u_out, 0, 0, down, img_y, img);
+            downsample_normalize (size_x - 2, size_y - 2, down, img);
+            sprintf (name_fic, "frame_%05d.ppm", i / insitu);
+            save_ppm (name_fic, img_x, img_y, img, 0., 1.);
+           }
+        }
       memcpy (u_in, u_out, sizeof (double) * size_x * size_y);
       if (err <= prec)
         break;
     }
+
+  if (stats != NULL)
+    fclose (stats);
+  free (img);
 }
 
 /**
@@ -151,12 +214,15 @@ compute_heat_propagation(double hx, double hy, double dt,
 static void
 usage(char *argv[])
 {
-  fprintf(stderr, "Usage: %s nx ny iter_max save\n", argv[0]);
+  fprintf(stderr, "Usage: %s nx ny iter_max save print [insitu [down [bc]]]\n", argv[0]);
   fprintf(stderr, "\tnx       number of discretisation points in X\n");
   fprintf(stderr, "\tny       number of discretisation points in Y\n");
   fprintf(stderr, "\titer_max maximal number of iterations in temporal loop\n");
   fprintf(stderr, "\tsave     boolean flag (1 or 0) for recording states\n");
   fprintf(stderr, "\tprint    boolean flag (1 or 0) for printing the states matrix to the standard output\n");
+  fprintf(stderr, "\tinsitu   period of the downsampled frames, 0 (default) disables in-situ output\n");
+  fprintf(stderr, "\tdown     downsampling factor of the frames (default 1)\n");
+  fprintf(stderr, "\tbc       boundary conditions: 0 (default) Dirichlet, 1 Neumann, 2 periodic\n");
   exit(EXIT_FAILURE);
 }
 
@@ -173,7 +239,9 @@ int
 main (int argc, char *argv[])
 {
   int nx=0, ny=0, size_x, size_y, save=0, print=0, iter_max=0;
+  int insitu=0, down=1, bc=HEAT_BC_DIRICHLET;
   double hx, hy, dt, dtmp;
+  struct heat_stencil s;
   double *u_in, *u_out, *u_tmp;
   clock_t start, end;
   double cpu_time_used;
@@ -186,7 +254,15 @@ main (int argc, char *argv[])
     iter_max = atoi (argv[3]);
     save = atoi(argv[4]);
     print = atoi(argv[5]);
+    if (argc > 6)
+      insitu = atoi(argv[6]);
+    if (argc > 7)
+      down = atoi(argv[7]);
+    if (argc > 8)
+      bc = atoi(argv[8]);
   }
+  if (insitu < 0 || down < 1 || bc < HEAT_BC_DIRICHLET || bc > HEAT_BC_PERIODIC)
+    usage(argv);
 
   hx = 1. / nx;
   hy = 1. / ny;
@@ -200,12 +276,25 @@ main (int argc, char *argv[])
   xalloc (u_tmp, size_x * size_y, double);
   u_tmp[0] = dtmp;
 
-  set_bounds (size_x, size_y, u_in);
-  set_bounds (size_x, size_y, u_out);
+  if (bc == HEAT_BC_DIRICHLET)
+    {
+      set_bounds (size_x, size_y, u_in);
+      set_bounds (size_x, size_y, u_out);
+    }
+  else
+    set_half (size_x, size_y, u_in);
+
+  s.hx = hx;
+  s.hy = hy;
+  s.dt = dt;
+  s.k = NULL;
+  s.src = NULL;
+  s.bc_x = (enum heat_bc) bc;
+  s.bc_y = (enum heat_bc) bc;
 
   start = clock();
-  compute_heat_propagation (hx, hy, dt, iter_max, save, print, size_x, size_y,
-                            u_in, u_out);
+  compute_heat_propagation (&s, iter_max, save, print, insitu, down,
+                            size_x, size_y, u_in, u_out);
   end = clock();
   cpu_time_used = ((double) (end - start)) / CLOCKS_PER_SEC;
   printf("<DartMeasurement name=\"Perf\" type=\"numeric/double\">%g</DartMeasurement>\n", cpu_time_used);
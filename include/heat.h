@@ -4,7 +4,8 @@
  * @author    Inria SED Bordeaux
  * @brief     Heat computation iteration code
  *
- * @details   This file declares the heat() function.
+ * @details   This file declares the heat() function and the heat_step()
+ * function for general stencils.
  */
 #ifndef __HEAT_H
 #define __HEAT_H
@@ -52,5 +53,98 @@ heat (double hx, double hy, double dt,
          int size_x, int size_y,
          const double *u_in, double *u_out);
 
+/**
+ * @brief Kind of boundary condition of one dimension of a heat_stencil
+ */
+enum heat_bc
+{
+  HEAT_BC_DIRICHLET, /**< fixed values, held by the boundary cells */
+  HEAT_BC_NEUMANN,   /**< zero flux across the boundary */
+  HEAT_BC_PERIODIC   /**< the map wraps around */
+};
+
+/**
+ * @brief Sides of a map, to be combined in the mask given to
+ * heat_fill_bounds(). N and S are the first and last rows (X dimension), W
+ * and E the first and last columns (Y dimension).
+ */
+#define HEAT_SIDE_N   1
+#define HEAT_SIDE_S   2
+#define HEAT_SIDE_E   4
+#define HEAT_SIDE_W   8
+#define HEAT_SIDE_ALL (HEAT_SIDE_N | HEAT_SIDE_S | HEAT_SIDE_E | HEAT_SIDE_W)
+
+/**
+ * @brief Description of a general heat equation stencil
+ *
+ * @details It describes the discretisation of
+ * <code>du/dt = div(k grad(u)) + f</code> on a 2-D cartesian map. @e k and
+ * @e src, when not NULL, are maps of the same size as the solution,
+ * boundary cells included; the conductivity between two cells is the mean
+ * of their conductivities. The boundary cells of @e k must therefore follow
+ * the same boundary conditions as the solution, e.g. hold the conductivity
+ * of the opposite side with periodic boundaries, otherwise heat is not
+ * conserved: calling heat_fill_bounds() once on @e k is enough.
+ */
+struct heat_stencil
+{
+  double hx;           /**< precision of the derivation over x */
+  double hy;           /**< precision of the derivation over y */
+  double dt;           /**< precision of the derivation over time */
+  const double *k;     /**< conductivity map, NULL for a constant 1; its
+                            boundary cells are filled by the caller */
+  const double *src;   /**< source term map @e f, NULL for none */
+  enum heat_bc bc_x;   /**< boundary condition of the N and S sides */
+  enum heat_bc bc_y;   /**< boundary condition of the W and E sides */
+};
+
+/**
+ * @brief Do a single iteration of a general stencil on a 2-D cartesian map.
+ *
+ * @details Like heat(), it computes every cell of @e u_out in
+ * <code>[1..size_x-2]x[1..size_y-2]</code> from @e u_in. The kernel is
+ * chosen once per call among specialized versions for each combination of
+ * constant or variable conductivity and source term, so that no branching
+ * happens in the loop; the constant-coefficient case without source is
+ * heat() itself. Boundary conditions are not applied here but by
+ * heat_fill_bounds(), which must be called on @e u_in beforehand.
+ *
+ * @param s the stencil description
+ * @param size_x the size of the cartesian map in x
+ * @param size_y the size of the cartesion map in y
+ * @param u_in the input map
+ * @param u_out the output map
+ * @return the square of the quadratic differences between @e u_in and @e u_out after
+ *         the execution of the function
+ */
+double
+heat_step (const struct heat_stencil *s,
+           int size_x, int size_y,
+           const double *u_in, double *u_out);
+
+/**
+ * @brief Fills the boundary cells of a map according to the boundary
+ * conditions of a stencil.
+ *
+ * @details Only the sides in @e sides are filled. Neumann sides receive the
+ * value of their adjacent significant cell and periodic sides the value of
+ * the significant cell on the opposite side of the map. Dirichlet sides are
+ * left untouched. It also fills the conductivity map of the stencil, which
+ * does not change over time and needs to be filled once. When the map is
+ * the part of a distributed solution, only
+ * the sides on the domain boundary should be given, periodic sides being
+ * exchanged with the neighbours instead.
+ *
+ * @param s the stencil description
+ * @param sides a mask of HEAT_SIDE_N, HEAT_SIDE_S, HEAT_SIDE_E and
+ *        HEAT_SIDE_W
+ * @param size_x the size of the cartesian map in x
+ * @param size_y the size of the cartesion map in y
+ * @param u the map to fill
+ */
+void
+heat_fill_bounds (const struct heat_stencil *s, int sides,
+                  int size_x, int size_y, double *u);
+
 
 #endif
@@ -0,0 +1,138 @@
+/**
+ * @file      insitu.c
+ * @copyright Copyright (c) 2018, Inria
+ * @author    Inria SED Bordeaux
+ * @brief     In-situ visualization and statistics library
+ *
+ * @details   This file provides functions to compute field statistics and
+ * to write downsampled images of a map while the simulation runs.
+ */
+#include "insitu.h"
+#include "heat.h"
+#include <float.h>
+#include <math.h>
+
+void
+field_stats (int size_x, int size_y, const double *u,
+             struct field_stats *st)
+{
+  int i, j;
+  double v;
+
+  st->min = DBL_MAX;
+  st->max = -DBL_MAX;
+  st->sum = 0.;
+  st->count = 0.;
+  for (i = 1; i < size_x - 1; ++i)
+    {
+      for (j = 1; j < size_y - 1; ++j)
+        {
+          v = u[i * size_y + j];
+          if (v < st->min)
+            st->min = v;
+          if (v > st->max)
+            st->max = v;
+          st->sum += v;
+        }
+    }
+  if (size_x > 2 && size_y > 2)
+    st->count = (double) (size_x - 2) * (size_y - 2);
+}
+
+void
+write_stats (FILE *fid, int it, double t, const struct field_stats *st,
+             double err)
+{
+  if (fid == NULL)
+    return;
+  if (ftell (fid) == 0)
+    fprintf (fid, "# it  t  min  max  mean  err\n");
+  fprintf (fid, "%d  %.6e  %.6e  %.6e  %.6e  %.6e\n", it, t, st->min, st->max,
+           st->count > 0. ? st->sum / st->count : 0., err);
+}
+
+void
+downsample_acc (int size_x, int size_y, const double *u,
+                int off_x, int off_y, int factor,
+                int img_y, double *img)
+{
+  int i, j;
+
+  for (i = 1; i < size_x - 1; ++i)
+    {
+      int p = (off_x + i - 1) / factor;
+      for (j = 1; j < size_y - 1; ++j)
+        {
+          img[p * img_y + (off_y + j - 1) / factor] += u[i * size_y + j];
+        }
+    }
+}
+
+void
+downsample_normalize (int nx, int ny, int factor, double *img)
+{
+  int p, q, img_x, img_y;
+
+  img_x = (nx + factor - 1) / factor;
+  img_y = (ny + factor - 1) / factor;
+  for (p = 0; p < img_x; ++p)
+    {
+      /* the last block of each dimension may be partial */
+      int cx = MIN (factor, nx - p * factor);
+      for (q = 0; q < img_y; ++q)
+        {
+          int cy = MIN (factor, ny - q * factor);
+          img[p * img_y + q] /= (double) (cx * cy);
+        }
+    }
+}
+
+/**
+ * @brief Maps a value in [0, 1] to one channel of the jet colour map
+ *
+ * @param v the normalized value
+ * @param c the center of the channel: 0.75 for red, 0.5 for green and 0.25
+ *        for blue
+ * @return the channel intensity in [0, 255]
+ */
+static unsigned char
+jet (double v, double c)
+{
+  double x = 1.5 - fabs (4. * (v - c));
+  if (x < 0.)
+    x = 0.;
+  if (x > 1.)
+    x = 1.;
+  return (unsigned char) (255. * x + 0.5);
+}
+
+void
+save_ppm (const char *filename, int img_x, int img_y, const double *img,
+          double vmin, double vmax)
+{
+  int p;
+  double v;
+  unsigned char rgb[3];
+  FILE *fid;
+
+  if (filename == NULL)  {
+    fprintf(stderr, "Error: input argument <filename> NULL\n");
+    return;
+  }
+  fid = fopen (filename, "wb");
+  if (fid == NULL) {
+    fprintf(stderr, "Error: unable to open <%s>\n", filename);
+    return;
+  }
+  /* rows of the image are the X dimension, as with heat_plot.py */
+  fprintf (fid, "P6\n%d %d\n255\n", img_y, img_x);
+  for (p = 0; p < img_x * img_y; ++p)
+    {
+      v = vmax > vmin ? (img[p] - vmin) / (vmax - vmin) : 0.;
+      rgb[0] = jet (v, 0.75);
+      rgb[1] = jet (v, 0.5);
+      rgb[2] = jet (v, 0.25);
+      fwrite (rgb, 1, 3, fid);
+    }
+  fclose (fid);
+}
@@ -0,0 +1,123 @@
+/**
+ * @file      insitu.h
+ * @copyright Copyright (c) 2018, Inria
+ * @author    Inria SED Bordeaux
+ * @brief     In-situ visualization and statistics library
+ *
+ * @details   This file provides functions to compute field statistics and
+ * to write downsampled images of a map while the simulation runs, so that
+ * full-resolution states do not have to be saved for post-processing.
+ */
+#ifndef __INSITU_H
+#define __INSITU_H
+
+#include <stdio.h>
+
+/**
+ * \defgroup GR_insitu In-situ output
+ * @{
+ */
+
+/**
+ * @brief Statistics of the significant cells of a map
+ *
+ * @details @e sum and @e count are kept instead of the mean so that partial
+ * statistics computed on several sub-domains can be summed up before the
+ * mean is taken.
+ */
+struct field_stats
+{
+  double min;    /**< minimum value */
+  double max;    /**< maximum value */
+  double sum;    /**< sum of the values */
+  double count;  /**< number of values */
+};
+
+/**
+ * @brief Computes the statistics of a map
+ *
+ * @details Only the cells in <code>[1..size_x-2]x[1..size_y-2]</code> are
+ * taken into account, the first and last rows and columns being boundaries
+ * or ghosts.
+ *
+ * @param size_x the size in X of the matrix u
+ * @param size_y the size in Y of the matrix u
+ * @param u the matrix to analyse
+ * @param st the statistics to fill
+ */
+void
+field_stats (int size_x, int size_y, const double *u,
+             struct field_stats *st);
+
+/**
+ * @brief Appends one line of statistics to a time series file
+ *
+ * @details The line contains the iteration, the time, the minimum, the
+ * maximum, the mean and the L2 change @e err of the step. If @e fid is at
+ * the beginning of the file, a commented header is written first.
+ *
+ * @param fid the opened file to write to
+ * @param it the iteration number
+ * @param t the simulated time
+ * @param st the statistics of the step
+ * @param err the L2 norm of the difference with the previous step
+ */
+void
+write_stats (FILE *fid, int it, double t, const struct field_stats *st,
+             double err);
+
+/**
+ * @brief Accumulates a map into a downsampled image
+ *
+ * @details Each significant cell <code>(i, j)</code> of @e u is added to the
+ * pixel <code>((off_x + i - 1) / factor, (off_y + j - 1) / factor)</code> of
+ * @e img. The offsets allow a sub-domain to accumulate its cells at their
+ * global position, so that the images of several sub-domains can be summed
+ * up. Use downsample_normalize() once every cell has been accumulated.
+ *
+ * @param size_x the size in X of the matrix u
+ * @param size_y the size in Y of the matrix u
+ * @param u the matrix to downsample
+ * @param off_x the global X index of the first significant row of u
+ * @param off_y the global Y index of the first significant column of u
+ * @param factor the downsampling factor
+ * @param img_y the size in Y of the image
+ * @param img the image to accumulate into
+ */
+void
+downsample_acc (int size_x, int size_y, const double *u,
+                int off_x, int off_y, int factor,
+                int img_y, double *img);
+
+/**
+ * @brief Turns an accumulated image into the mean of each pixel block
+ *
+ * @param nx the number of significant cells in X of the full map
+ * @param ny the number of significant cells in Y of the full map
+ * @param factor the downsampling factor
+ * @param img the image filled by downsample_acc(), of size
+ *        ceil(nx / factor) x ceil(ny / factor)
+ */
+void
+downsample_normalize (int nx, int ny, int factor, double *img);
+
+/**
+ * @brief Saves an image in the binary PPM format using a jet colour map
+ *
+ * @details Values are clamped to <code>[vmin, vmax]</code>, as does
+ * @e heat_plot.py.
+ *
+ * @param filename the file to output the image
+ * @param img_x the size in X of the image
+ * @param img_y the size in Y of the image
+ * @param img the image to save
+ * @param vmin the value mapped to the first colour
+ * @param vmax the value mapped to the last colour
+ */
+void
+save_ppm (const char *filename, int img_x, int img_y, const double *img,
+          double vmin, double vmax);
+
+/**@}*/
+
+#endif
@@ -4,10 +4,12 @@
  * @author    Inria SED Bordeaux
  * @brief     Heat computation iteration code
  *
- * @details   This file defines the heat() function.
+ * @details   This file defines the heat() function and the heat_step()
+ * function for general stencils.
  */
 
 #include "heat.h"
+#include <stddef.h>
 
 double
 heat (double hx, double hy, double dt,
@@ -34,3 +36,100 @@ heat (double hx, double hy, double dt,
         }
     return err;
 }
+
+/* Flux terms of the specialized kernels, @e c being the index of the cell */
+#define FLUX_CONST(c)                                                   \
+  (w_x * (u_in[(c) - size_y] + u_in[(c) + size_y] - 2. * u_in[c])      \
+   + w_y * (u_in[(c) - 1] + u_in[(c) + 1] - 2. * u_in[c]))
+#define FLUX_VAR(c)                                                     \
+  (.5 * w_x * ((s->k[c] + s->k[(c) + size_y]) * (u_in[(c) + size_y] - u_in[c]) \
+               - (s->k[c] + s->k[(c) - size_y]) * (u_in[c] - u_in[(c) - size_y])) \
+   + .5 * w_y * ((s->k[c] + s->k[(c) + 1]) * (u_in[(c) + 1] - u_in[c]) \
+                 - (s->k[c] + s->k[(c) - 1]) * (u_in[c] - u_in[(c) - 1])))
+#define SOURCE(c) (s->dt * s->src[c])
+
+/* Defines a kernel named NAME computing u_out[c] = u_in[c] + UPDATE(c) */
+#define HEAT_KERNEL(NAME, UPDATE)                                       \
+  static double                                                         \
+  NAME (const struct heat_stencil *s, int size_x, int size_y,           \
+        const double *u_in, double *u_out)                              \
+  {                                                                     \
+    int i, j, c;                                                        \
+    double w_x, w_y, err;                                               \
+                                                                        \
+    w_x = s->dt / (s->hx * s->hx);                                      \
+    w_y = s->dt / (s->hy * s->hy);                                      \
+                                                                        \
+    err = 0.;                                                           \
+    for (i = 1; i < size_x - 1; ++i)                                    \
+      {                                                                 \
+        for (j = 1; j < size_y - 1; ++j)                                \
+          {                                                             \
+            c = i * size_y + j;                                         \
+            u_out[c] = u_in[c] + UPDATE(c);                             \
+            err += SQR (u_out[c] - u_in[c]);                            \
+          }                                                             \
+      }                                                                 \
+    return err;                                                         \
+  }
+
+#define UPDATE_CONST_SRC(c) (FLUX_CONST(c) + SOURCE(c))
+#define UPDATE_VAR(c)       (FLUX_VAR(c))
+#define UPDATE_VAR_SRC(c)   (FLUX_VAR(c) + SOURCE(c))
+
+HEAT_KERNEL (heat_const_src, UPDATE_CONST_SRC)
+HEAT_KERNEL (heat_var, UPDATE_VAR)
+HEAT_KERNEL (heat_var_src, UPDATE_VAR_SRC)
+
+double
+heat_step (const struct heat_stencil *s,
+           int size_x, int size_y,
+           const double *u_in, double *u_out)
+{
+  if (s->k == NULL)
+    {
+      if (s->src == NULL)
+        return heat (s->hx, s->hy, s->dt, size_x, size_y, u_in, u_out);
+      return heat_const_src (s, size_x, size_y, u_in, u_out);
+    }
+  if (s->src == NULL)
+    return heat_var (s, size_x, size_y, u_in, u_out);
+  return heat_var_src (s, size_x, size_y, u_in, u_out);
+}
+
+void
+heat_fill_bounds (const struct heat_stencil *s, int sides,
+                  int size_x, int size_y, double *u)
+{
+  int i, j;
+
+  /* N and S sides: rows 0 and size_x - 1 */
+  if (s->bc_x != HEAT_BC_DIRICHLET)
+    {
+      int periodic = s->bc_x == HEAT_BC_PERIODIC;
+      int from_n = periodic ? size_x - 2 : 1;
+      int from_s = periodic ? 1 : size_x - 2;
+      for (j = 0; j < size_y; ++j)
+        {
+          if (sides & HEAT_SIDE_N)
+            u[0 * size_y + j] = u[from_n * size_y + j];
+          if (sides & HEAT_SIDE_S)
+            u[(size_x - 1) * size_y + j] = u[from_s * size_y + j];
+        }
+    }
+
+  /* W and E sides: columns 0 and size_y - 1 */
+  if (s->bc_y != HEAT_BC_DIRICHLET)
+    {
+      int periodic = s->bc_y == HEAT_BC_PERIODIC;
+      int from_w = periodic ? size_y - 2 : 1;
+      int from_e = periodic ? 1 : size_y - 2;
+      for (i = 0; i < size_x; ++i)
+        {
+          if (sides & HEAT_SIDE_W)
+            u[i * size_y + 0] = u[i * size_y + from_w];
+          if (sides & HEAT_SIDE_E)
+            u[i * size_y + size_y - 1] = u[i * size_y + from_e];
+        }
+    }
+}
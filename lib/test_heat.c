@@ -0,0 +1,203 @@
+/**
+ * @file      test_heat.c
+ * @copyright Copyright (c) 2018, Inria
+ * @author    Inria SED Bordeaux
+ * @brief     Heat computation iteration code test
+ *
+ * @details   This file checks the specialized kernels of heat_step() and
+ * heat_fill_bounds() against heat(), and that heat is conserved with
+ * periodic boundaries and a variable conductivity.
+ */
+#include "heat.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SIZE_X 10
+#define SIZE_Y 12
+#define SIZE   (SIZE_X * SIZE_Y)
+#define TOL    1e-14
+
+/**
+ * @brief Compares the result of a kernel to the expected one
+ *
+ * @details The significant cells of @e u and @e ref and the returned errors
+ * must agree up to TOL. The result of the check is printed out.
+ *
+ * @param name the name of the check
+ * @param ref the expected map
+ * @param u the computed map
+ * @param err_ref the expected error
+ * @param err the error returned by the kernel
+ * @return 0 if the check passes, 1 otherwise
+ */
+static int
+check (const char *name, const double *ref, const double *u,
+       double err_ref, double err)
+{
+  int i, j;
+  double diff = fabs (err - err_ref) / (1. + err_ref);
+
+  for (i = 1; i < SIZE_X - 1; ++i)
+    {
+      for (j = 1; j < SIZE_Y - 1; ++j)
+        {
+          diff = fmax (diff, fabs (u[i * SIZE_Y + j] - ref[i * SIZE_Y + j]));
+        }
+    }
+  printf ("test_heat: %-32s %s (%.3e)\n", name, diff <= TOL ? "ok" : "FAILED",
+          diff);
+  return diff > TOL;
+}
+
+/**
+ * @brief Computes the error returned by a kernel producing @e u_out
+ *
+ * @param u_in the input map
+ * @param u_out the output map
+ * @return the square of the quadratic differences between @e u_in and
+ *         @e u_out on the significant cells
+ */
+static double
+step_err (const double *u_in, const double *u_out)
+{
+  int i, j;
+  double err = 0.;
+
+  for (i = 1; i < SIZE_X - 1; ++i)
+    {
+      for (j = 1; j < SIZE_Y - 1; ++j)
+        {
+          err += SQR (u_out[i * SIZE_Y + j] - u_in[i * SIZE_Y + j]);
+        }
+    }
+  return err;
+}
+
+/**
+ * @brief Computes the total heat of a map
+ *
+ * @param u the map
+ * @return the sum of the significant cells of @e u
+ */
+static double
+map_sum (const double *u)
+{
+  int i, j;
+  double sum = 0.;
+
+  for (i = 1; i < SIZE_X - 1; ++i)
+    {
+      for (j = 1; j < SIZE_Y - 1; ++j)
+        {
+          sum += u[i * SIZE_Y + j];
+        }
+    }
+  return sum;
+}
+
+/**
+ * @brief Main procedure
+ *
+ * @return the number of failed checks
+ */
+int
+main (void)
+{
+  int i, j, it, failures = 0;
+  double u_in[SIZE], u_out[SIZE], ref[SIZE], ref_src[SIZE];
+  double one[SIZE], two[SIZE], zero[SIZE], src[SIZE], k[SIZE];
+  double err, err_ref, err_src, sum_in, sum_out;
+  struct heat_stencil s = { .1, .1, .0025, NULL, NULL,
+                            HEAT_BC_DIRICHLET, HEAT_BC_DIRICHLET };
+
+  srand (2018);
+  for (i = 0; i < SIZE; ++i)
+    {
+      u_in[i] = rand () / (double) RAND_MAX;
+      src[i] = rand () / (double) RAND_MAX;
+      one[i] = 1.;
+      two[i] = 2.;
+      zero[i] = 0.;
+    }
+
+  // reference: constant-coefficient kernel
+  err_ref = heat (s.hx, s.hy, s.dt, SIZE_X, SIZE_Y, u_in, ref);
+
+  err = heat_step (&s, SIZE_X, SIZE_Y, u_in, u_out);
+  failures += check ("constant", ref, u_out, err_ref, err);
+
+  s.k = one;
+  err = heat_step (&s, SIZE_X, SIZE_Y, u_in, u_out);
+  failures += check ("variable k = 1", ref, u_out, err_ref, err);
+
+  s.src = zero;
+  err = heat_step (&s, SIZE_X, SIZE_Y, u_in, u_out);
+  failures += check ("variable k = 1, src = 0", ref, u_out, err_ref, err);
+
+  s.k = NULL;
+  err = heat_step (&s, SIZE_X, SIZE_Y, u_in, u_out);
+  failures += check ("constant, src = 0", ref, u_out, err_ref, err);
+
+  // a source adds dt * src to each cell
+  for (i = 0; i < SIZE; ++i)
+    ref_src[i] = ref[i] + s.dt * src[i];
+  err_src = step_err (u_in, ref_src);
+
+  s.src = src;
+  err = heat_step (&s, SIZE_X, SIZE_Y, u_in, u_out);
+  failures += check ("constant, src", ref_src, u_out, err_src, err);
+
+  // a conductivity of 2 is a time step twice as long, the source excepted
+  heat (s.hx, s.hy, 2. * s.dt, SIZE_X, SIZE_Y, u_in, ref);
+  for (i = 0; i < SIZE; ++i)
+    ref_src[i] = ref[i] + s.dt * src[i];
+  err_src = step_err (u_in, ref_src);
+
+  s.k = two;
+  err = heat_step (&s, SIZE_X, SIZE_Y, u_in, u_out);
+  failures += check ("variable k = 2, src", ref_src, u_out, err_src, err);
+
+  // periodic in X and Neumann in Y
+  s.bc_x = HEAT_BC_PERIODIC;
+  s.bc_y = HEAT_BC_NEUMANN;
+  heat_fill_bounds (&s, HEAT_SIDE_ALL, SIZE_X, SIZE_Y, u_in);
+  err = 0.;
+  for (j = 1; j < SIZE_Y - 1; ++j)
+    {
+      err = fmax (err, fabs (u_in[0 * SIZE_Y + j] - u_in[(SIZE_X - 2) * SIZE_Y + j]));
+      err = fmax (err, fabs (u_in[(SIZE_X - 1) * SIZE_Y + j] - u_in[1 * SIZE_Y + j]));
+    }
+  for (i = 0; i < SIZE_X; ++i)
+    {
+      err = fmax (err, fabs (u_in[i * SIZE_Y + 0] - u_in[i * SIZE_Y + 1]));
+      err = fmax (err, fabs (u_in[i * SIZE_Y + SIZE_Y - 1] - u_in[i * SIZE_Y + SIZE_Y - 2]));
+    }
+  printf ("test_heat: %-32s %s\n", "periodic X, Neumann Y bounds",
+          err == 0. ? "ok" : "FAILED");
+  failures += err != 0.;
+
+  // periodic with a variable conductivity: the boundary cells of k are
+  // filled as the ones of the solution, so that heat is conserved
+  s.bc_y = HEAT_BC_PERIODIC;
+  s.src = NULL;
+  for (i = 0; i < SIZE; ++i)
+    k[i] = .5 + .5 * rand () / (double) RAND_MAX;
+  heat_fill_bounds (&s, HEAT_SIDE_ALL, SIZE_X, SIZE_Y, k);
+  s.k = k;
+  sum_in = map_sum (u_in);
+  for (it = 0; it < 10; ++it)
+    {
+      heat_fill_bounds (&s, HEAT_SIDE_ALL, SIZE_X, SIZE_Y, u_in);
+      heat_step (&s, SIZE_X, SIZE_Y, u_in, u_out);
+      for (i = 0; i < SIZE; ++i)
+        u_in[i] = u_out[i];
+    }
+  sum_out = map_sum (u_in);
+  err = fabs (sum_out - sum_in) / sum_in;
+  printf ("test_heat: %-32s %s (%.3e)\n", "periodic, variable k conserved",
+          err <= TOL ? "ok" : "FAILED", err);
+  failures += err > TOL;
+
+  return failures;
+}
@@ -0,0 +1,111 @@
+#!/bin/bash
+
+# Strong/weak scaling benchmark of heat_par, run by CTest.
+#
+# usage: scaling.sh mode size iters decomps baseline output tolerance heat_par mpiexec np_flag
+#   mode      strong (size is the global grid size) or weak (size is the grid
+#             size of each process)
+#   size      grid size in X and Y
+#   iters     number of iterations of each run
+#   decomps   comma-separated process grids pxXpy, e.g. 1x1,2x1,2x2; the
+#             first one is the reference of the efficiency
+#   baseline  file of "mode ranks efficiency" lines
+#   output    csv file receiving the results
+#   tolerance allowed decrease of the efficiency under the baseline
+#
+# The processes are allowed to oversubscribe the cores. The efficiency is
+# computed against the cores actually available, so that running 4 processes
+# on 2 cores is expected to be 2 times faster than on 1 core, not 4 times.
+# Set HEAT_SCALING_UPDATE=1 to write the measured efficiencies as the new
+# baseline of the mode.
+
+[ $# -lt 10 ] && echo "Usage: $0 mode size iters decomps baseline output tolerance heat_par mpiexec np_flag" && exit 1
+
+mode=$1
+size=$2
+iters=$3
+decomps=$4
+baseline=$5
+output=$6
+tolerance=$7
+heat_par=$8
+mpiexec=$9
+np_flag=${10}
+
+# number of repetitions of each run, the median one is kept
+reps=3
+
+cores=$(nproc 2>/dev/null || getconf _NPROCESSORS_ONLN)
+export OMPI_MCA_rmaps_base_oversubscribe=1
+
+rundir=$(mktemp -d)
+trap 'rm -rf "$rundir"' EXIT
+cd "$rundir" || exit 1
+
+echo "mode,ranks,px,py,nx,ny,iters,cores,time_per_step,efficiency,compute,reduce,exchange,insitu" > "$output"
+
+status=0
+t_ref=""
+for decomp in ${decomps//,/ }
+do
+  px=${decomp%x*}
+  py=${decomp#*x}
+  np=$((px * py))
+  if [ "$mode" = "weak" ]; then
+    nx=$((size * px))
+    ny=$((size * py))
+  else
+    nx=$size
+    ny=$size
+  fi
+
+  # keep the median of the repetitions, times are given per step
+  : > "$rundir/runs"
+  for r in $(seq $reps)
+  do
+    line=$($mpiexec $np_flag $np "$heat_par" $nx $ny $iters $px $py 0 | grep "heat: timing")
+    if [ -z "$line" ]; then
+      echo "heat_par failed on $np processes ($decomp)"
+      exit 1
+    fi
+    timing=$(echo "$line" | awk -F'[=,]' '{ it = $4; printf "%d %.6e %.6e %.6e %.6e %.6e", it, $6 / it, $8 / it, $10 / it, $12 / it, $14 / it }')
+    echo "$timing" >> "$rundir/runs"
+  done
+  read -r it t_step t_comp t_red t_exch t_insitu <<< "$(sort -g -k2 "$rundir/runs" | sed -n "$(((reps + 1) / 2))p")"
+
+  # reference run
+  if [ -z "$t_ref" ]; then
+    t_ref=$t_step
+    np_ref=$np
+  fi
+
+  # ideal time with the available cores, relatively to the reference run
+  eff=$(awk -v mode="$mode" -v t1="$t_ref" -v p1="$np_ref" -v tp="$t_step" -v p="$np" -v c="$cores" 'BEGIN {
+    c1 = (p1 < c) ? p1 : c
+    cp = (p < c) ? p : c
+    ideal = t1 * c1 / cp
+    if (mode == "weak")
+      ideal = ideal * p / p1
+    printf "%.4f", ideal / tp
+  }')
+
+  echo "$mode,$np,$px,$py,$nx,$ny,$it,$cores,$t_step,$eff,$t_comp,$t_red,$t_exch,$t_insitu" >> "$output"
+  echo "$mode scaling: $np processes ($decomp), ${nx}x${ny}, $t_step s/step, efficiency $eff"
+  echo "<DartMeasurement name=\"Efficiency_$np\" type=\"numeric/double\">$eff</DartMeasurement>"
+
+  # compare to the baseline
+  base=$(awk -v mode="$mode" -v p="$np" '$1 == mode && $2 == p { print $3 }' "$baseline" 2>/dev/null)
+  if [ -n "$base" ] && awk -v e="$eff" -v b="$base" -v t="$tolerance" 'BEGIN { exit !(e < b - t) }'; then
+    echo "  efficiency $eff regressed below the baseline $base (tolerance $tolerance)"
+    status=1
+  fi
+done
+
+if [ "$HEAT_SCALING_UPDATE" = "1" ]; then
+  grep -v "^$mode " "$baseline" > "$rundir/baseline" 2>/dev/null
+  awk -F, -v mode="$mode" '$1 == mode { print $1, $2, $10 }' "$output" >> "$rundir/baseline"
+  cp "$rundir/baseline" "$baseline"
+  echo "baseline of $mode scaling updated in $baseline"
+fi
+
+exit $status